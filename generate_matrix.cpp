@@ -2,6 +2,10 @@
 #include <fstream>  // FOR FILE STREAM OPERATION
 #include <cstdlib>  // FOR RAND(), SRAND()
 #include <ctime>    // FOR TIME() TO SEED THE RAND
+#include <memory>   // FOR THE OPTIONAL COMPRESSED WRITER
+#include <string>   // FOR COMMAND LINE FLAGS
+#include <vector>   // FOR BUFFERING ONE ROW
+#include "graph_codec.h" // FOR THE COMPRESSED BLOCK FORMAT
 
 // DEFINE SIZE WEIGHT AND EDGE
 
@@ -14,20 +18,32 @@
 // DEFINE A CONSTANT TO REPRESENT NO EDGE BETWEEN NODES
 #define NO_EDGE 9999
 
-int main()
+int main(int argc, char** argv)
 {
+    // --compressed WRITES input.pmb (COMPRESSED BLOCK FORMAT) INSTEAD OF input.csv
+    bool compressed = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--compressed") compressed = true;
+    }
+    std::string output_file = compressed ? "input.pmb" : "input.csv";
 
     // OPEN FILE FOR WRITING
     // CREATE AN OUTPUT FILE STREAM OBJECT TO WRITE
-    std::ofstream fout("input.csv");
+    std::ofstream fout;
+    std::unique_ptr<CompressedGraphWriter> writer;
+    if (compressed) writer.reset(new CompressedGraphWriter(output_file, SIZE, NO_EDGE));
+    else fout.open(output_file);
 
     // CHECK IF FILE OPEN SUCCESSFULLY
-    if (!fout.is_open())
+    if (!(compressed ? writer->is_open() : fout.is_open()))
     {
         std::cerr << "Failed to open file. \n";
         return 1;
     }
 
+    std::vector<int> row(SIZE);
+
     // Initialize the random number generator with current system time
     srand(time(0));
 
@@ -61,8 +77,20 @@ int main()
                     weight = rand() % MAX_WEIGHT + 1; // Edge with weight 1–100
                 }
             }
+            row[j] = weight;
+        }
+
+        if (compressed)
+        {
+            // ROWS ARE BUFFERED AND ENCODED ONE BLOCK AT A TIME
+            writer->add_row(row);
+            continue;
+        }
+
+        for (int j = 0; j < SIZE; j++)
+        {
             // WRITE WEIGHT TO THE CSV FILE
-            fout << weight;
+            fout << row[j];
 
             // Add comma except for last column in the row
             if (j != SIZE - 1)
@@ -76,10 +104,23 @@ int main()
     }
 
     // Close the output file after writing is done
-    fout.close();
+    bool written;
+    if (compressed) written = writer->close();
+    else
+    {
+        fout.close();
+        written = !fout.fail();
+    }
+
+    // CHECK THAT EVERY ROW REACHED THE DISK
+    if (!written)
+    {
+        std::cerr << "Failed to write " << output_file << "\n";
+        return 1;
+    }
 
     // Notify user of successful matrix generation
-    std::cout << "Matrix generated to input.csv\n";
+    std::cout << "Matrix generated to " << output_file << "\n";
 
     return 0; // Program ended successfully
 }
@@ -0,0 +1,270 @@
+// Compressed block format for the dense adjacency matrices (input.pmb).
+//
+// Layout (native byte order):
+//   header      magic "PRMB", version, V, sentinel, rows_per_block, blocks
+//   index       blocks x {offset, bytes} pointing at each block in the file
+//   blocks      independent, so they can be decoded in parallel
+//
+// A block covers rows_per_block consecutive rows:
+//   int32 base, uint32 width, uint64 count
+//   one bitmap per row (bit j set = entry j is not the sentinel)
+//   count values, each stored as (value - base) in `width` bits
+//
+// Most entries of a generated graph are the sentinel 9999 (1 bit each), and
+// the weights 0..100 pack into 7 bits, so a file is a small fraction of the CSV.
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#define PMB_MAGIC "PRMB"
+#define PMB_VERSION 1
+#define PMB_ROWS_PER_BLOCK 64
+
+struct PmbHeader {
+    char magic[4];
+    uint32_t version;
+    int32_t vertices;
+    int32_t sentinel;
+    int32_t rows_per_block;
+    int32_t blocks;
+};
+
+struct PmbIndexEntry {
+    uint64_t offset;   // from the start of the file
+    uint64_t bytes;
+};
+
+struct PmbBlockHeader {
+    int32_t base;
+    uint32_t width;
+    uint64_t count;
+};
+
+// Streams rows into a compressed file one block at a time, so the full
+// matrix never has to be held in memory. The index is written on close().
+class CompressedGraphWriter {
+public:
+    CompressedGraphWriter(const std::string& path, int V, int sentinel, int rows_per_block = PMB_ROWS_PER_BLOCK)
+        : fout(path, std::ios::binary), V(V), sentinel(sentinel), rows_per_block(rows_per_block) {
+        int blocks = (V + rows_per_block - 1) / rows_per_block;
+        index.resize(blocks);
+
+        PmbHeader h;
+        memcpy(h.magic, PMB_MAGIC, 4);
+        h.version = PMB_VERSION;
+        h.vertices = V;
+        h.sentinel = sentinel;
+        h.rows_per_block = rows_per_block;
+        h.blocks = blocks;
+        fout.write((const char*) &h, sizeof(h));
+        // Placeholder, rewritten once the block sizes are known
+        fout.write((const char*) index.data(), index.size() * sizeof(PmbIndexEntry));
+    }
+
+    bool is_open() const { return fout.is_open(); }
+
+    // Appends the next row; a row without exactly V entries is refused and fails close()
+    bool add_row(const std::vector<int>& row) {
+        if ((int) row.size() != V || added == V) {
+            bad_rows = true;
+            return false;
+        }
+        added++;
+        pending.push_back(row);
+        if ((int) pending.size() == rows_per_block) flush_block();
+        return true;
+    }
+
+    // Writes the index and closes the file. False if any write failed,
+    // a row was refused, or fewer than V rows were added.
+    bool close() {
+        if (!fout.is_open()) return ok;
+        if (!pending.empty()) flush_block();
+        fout.seekp(sizeof(PmbHeader));
+        fout.write((const char*) index.data(), index.size() * sizeof(PmbIndexEntry));
+        fout.close();
+        ok = !fout.fail() && !bad_rows && added == V;
+        return ok;
+    }
+
+    ~CompressedGraphWriter() { close(); }
+
+private:
+    std::ofstream fout;
+    int V, sentinel, rows_per_block;
+    int next_block = 0;
+    int added = 0;
+    bool bad_rows = false;
+    bool ok = false;
+    std::vector<PmbIndexEntry> index;
+    std::vector<std::vector<int>> pending;
+
+    void flush_block() {
+        size_t bitmap_bytes = (V + 7) / 8;
+
+        // Frame of reference: pack every present value relative to the block minimum
+        PmbBlockHeader bh = {0, 0, 0};
+        int64_t lo = INT64_MAX, hi = INT64_MIN;
+        for (const auto& row : pending)
+            for (int v : row)
+                if (v != sentinel) {
+                    lo = std::min<int64_t>(lo, v);
+                    hi = std::max<int64_t>(hi, v);
+                    bh.count++;
+                }
+        if (bh.count) {
+            bh.base = (int32_t) lo;
+            uint64_t range = (uint64_t) (hi - lo);
+            while (bh.width < 32 && (range >> bh.width)) bh.width++;
+        }
+
+        std::vector<uint8_t> out(sizeof(bh) + pending.size() * bitmap_bytes + (bh.count * bh.width + 7) / 8, 0);
+        memcpy(out.data(), &bh, sizeof(bh));
+        uint8_t* bitmap = out.data() + sizeof(bh);
+        uint8_t* packed = bitmap + pending.size() * bitmap_bytes;
+
+        // Bit writer: acc holds nbits not yet flushed, lowest bit first
+        uint64_t acc = 0;
+        uint32_t nbits = 0;
+        for (size_t r = 0; r < pending.size(); r++) {
+            const std::vector<int>& row = pending[r];
+            for (int j = 0; j < V; j++) {
+                if (row[j] == sentinel) continue;
+                bitmap[r * bitmap_bytes + j / 8] |= (uint8_t) (1u << (j % 8));
+                acc |= (uint64_t) ((int64_t) row[j] - bh.base) << nbits;
+                nbits += bh.width;
+                while (nbits >= 8) {
+                    *packed++ = (uint8_t) acc;
+                    acc >>= 8;
+                    nbits -= 8;
+                }
+            }
+        }
+        if (nbits) *packed = (uint8_t) acc;
+
+        index[next_block].offset = (uint64_t) fout.tellp();
+        index[next_block].bytes = out.size();
+        next_block++;
+        fout.write((const char*) out.data(), out.size());
+        pending.clear();
+    }
+};
+
+// True if the file starts with the compressed-graph magic
+inline bool is_compressed_graph(const std::string& path) {
+    std::ifstream fin(path, std::ios::binary);
+    char magic[4] = {0};
+    fin.read(magic, 4);
+    return fin && memcmp(magic, PMB_MAGIC, 4) == 0;
+}
+
+// Reads a whole file into memory
+inline bool read_file_bytes(const std::string& path, std::vector<char>& data) {
+    std::ifstream fin(path, std::ios::binary | std::ios::ate);
+    if (!fin.is_open()) return false;
+    data.resize((size_t) fin.tellg());
+    fin.seekg(0);
+    fin.read(data.data(), data.size());
+    return (bool) fin;
+}
+
+// Decodes one block into rows [first, first + rows) of graph
+inline bool decode_block(const uint8_t* p, uint64_t bytes, int V, int sentinel,
+                         int first, int rows, std::vector<std::vector<int>>& graph) {
+    PmbBlockHeader bh;
+    size_t bitmap_bytes = (V + 7) / 8;
+    if (bytes < sizeof(bh)) return false;
+    memcpy(&bh, p, sizeof(bh));
+    if (bh.width > 32 || bytes < sizeof(bh) + rows * bitmap_bytes + (bh.count * bh.width + 7) / 8) return false;
+
+    const uint8_t* bitmap = p + sizeof(bh);
+    const uint8_t* packed = bitmap + rows * bitmap_bytes;
+    const uint8_t* packed_end = p + bytes;
+    uint64_t mask = bh.width == 32 ? 0xffffffffull : ((1ull << bh.width) - 1);
+
+    // Bit reader: acc holds nbits not yet consumed, lowest bit first
+    uint64_t acc = 0;
+    uint32_t nbits = 0;
+    uint64_t seen = 0;
+
+    for (int r = 0; r < rows; r++) {
+        std::vector<int>& row = graph[first + r];
+        row.assign(V, sentinel);
+        const uint8_t* bits = bitmap + r * bitmap_bytes;
+        // Walk only the set bits, so long sentinel runs cost one byte test per 8 entries
+        for (size_t byte = 0; byte < bitmap_bytes; byte++) {
+            unsigned m = bits[byte];
+            while (m) {
+                size_t j = byte * 8 + __builtin_ctz(m);
+                m &= m - 1;
+                if (j >= (size_t) V || ++seen > bh.count) return false;
+                while (nbits < bh.width && packed < packed_end) {
+                    acc |= (uint64_t) *packed++ << nbits;
+                    nbits += 8;
+                }
+                row[j] = (int) ((int64_t) bh.base + (int64_t) (acc & mask));
+                acc >>= bh.width;
+                nbits -= bh.width;
+            }
+        }
+    }
+    return seen == bh.count;
+}
+
+// Reads and checks the header and block index of an in-memory compressed graph
+inline bool read_compressed_header(const std::vector<char>& data, PmbHeader& h, std::vector<PmbIndexEntry>& index) {
+    if (data.size() < sizeof(h)) return false;
+    memcpy(&h, data.data(), sizeof(h));
+    if (memcmp(h.magic, PMB_MAGIC, 4) != 0 || h.version != PMB_VERSION) return false;
+    if (h.vertices < 0 || h.rows_per_block <= 0 || h.blocks != (h.vertices + h.rows_per_block - 1) / h.rows_per_block)
+        return false;
+    if (data.size() < sizeof(h) + (size_t) h.blocks * sizeof(PmbIndexEntry)) return false;
+
+    index.resize(h.blocks);
+    memcpy(index.data(), data.data() + sizeof(h), index.size() * sizeof(PmbIndexEntry));
+    return true;
+}
+
+// Decodes blocks [first_block, last_block) into their rows of graph, which
+// must already hold V rows; in parallel when built with OpenMP
+inline bool decode_compressed_blocks(const std::vector<char>& data, const PmbHeader& h,
+                                     const std::vector<PmbIndexEntry>& index, int first_block, int last_block,
+                                     std::vector<std::vector<int>>& graph) {
+    const uint8_t* base = (const uint8_t*) data.data();
+    bool ok = true;
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) reduction(&& : ok)
+#endif
+    for (int b = first_block; b < last_block; b++) {
+        const PmbIndexEntry& e = index[b];
+        if (e.offset > data.size() || e.bytes > data.size() - e.offset) {
+            ok = false;
+            continue;
+        }
+        int first = b * h.rows_per_block;
+        int rows = std::min(h.rows_per_block, h.vertices - first);
+        ok = decode_block(base + e.offset, e.bytes, h.vertices, h.sentinel, first, rows, graph) && ok;
+    }
+    return ok;
+}
+
+// Decodes a whole in-memory compressed graph. Returns false if the data is malformed.
+inline bool decode_compressed_graph(const std::vector<char>& data, std::vector<std::vector<int>>& graph) {
+    PmbHeader h;
+    std::vector<PmbIndexEntry> index;
+    if (!read_compressed_header(data, h, index)) return false;
+    graph.assign(h.vertices, std::vector<int>());
+    return decode_compressed_blocks(data, h, index, 0, h.blocks, graph);
+}
+
+// Loads a compressed graph file into the in-memory adjacency matrix
+inline bool read_compressed_graph(const std::string& path, std::vector<std::vector<int>>& graph) {
+    std::vector<char> data;
+    return read_file_bytes(path, data) && decode_compressed_graph(data, graph);
+}
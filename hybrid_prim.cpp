@@ -5,6 +5,12 @@
 #include <vector>
 #include <string>
 #include <limits>
+#include <algorithm>
+#include "prim_perf.h"  // Optional hardware counter profiling
+#include "graph_codec.h" // Compressed block graph format
+#include "mst_cache.h"   // Content-addressed MST result cache
+#include "mst_cluster.h" // Single-linkage clustering of the MST
+#include "prim_options.h" // Shared command-line options
 
 #define INF 9999        // A large number representing 'infinity'
 
@@ -42,9 +48,71 @@ void write_csv(const vector<vector<int>>& mat, const string& filename) {
     }
 }
 
+// Block-cyclic owner of index g along a grid dimension of n ranks (blocks of nb indices)
+int cyclic_owner(int g, int nb, int n) {
+    return (g / nb) % n;
+}
+
+// Indices 0..V-1 owned by grid coordinate c, in ascending order
+vector<int> cyclic_indices(int V, int nb, int n, int c) {
+    vector<int> idx;
+    for (int g = c * nb; g < V; g += n * nb)
+        for (int k = g; k < min(V, g + nb); k++) idx.push_back(k);
+    return idx;
+}
+
+// Rank 0 cuts the graph into tiles and sends each rank its own:
+// tile[a * nk + b] = graph[sources[a]][keys[b]], several source rows per message
+void scatter_tiles(const vector<vector<int>>& graph, vector<int>& tile, int V, int nb,
+                   int prow, int pcol, int rank, int size) {
+    const size_t CHUNK = 1 << 24; // ints per message, well under the int count limit
+    for (int d = 0; d < size; d++) {
+        if (rank != 0 && rank != d) continue;
+        vector<int> keys = cyclic_indices(V, nb, prow, d / pcol);
+        vector<int> sources = cyclic_indices(V, nb, pcol, d % pcol);
+        size_t nk = keys.size(), ns = sources.size();
+        size_t rows_per_msg = max<size_t>(1, CHUNK / max<size_t>(1, nk));
+
+        vector<int> buf;
+        for (size_t a0 = 0; a0 < ns; a0 += rows_per_msg) {
+            size_t a1 = min(ns, a0 + rows_per_msg);
+            int n = (a1 - a0) * nk;
+            if (rank == d && d != 0) {
+                MPI_Recv(tile.data() + a0 * nk, n, MPI_INT, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                continue;
+            }
+            int* out = d == 0 ? tile.data() + a0 * nk : (buf.resize(n), buf.data());
+            for (size_t a = a0; a < a1; a++) {
+                const vector<int>& row = graph[sources[a]];
+                for (size_t b = 0; b < nk; b++) out[(a - a0) * nk + b] = row[keys[b]];
+            }
+            if (d != 0) MPI_Send(buf.data(), n, MPI_INT, d, 0, MPI_COMM_WORLD);
+        }
+    }
+}
+
+// Gathers every rank's profile report on rank 0 and prints them in rank order
+void print_rank_reports(const string& report, int rank, int size) {
+    int len = report.size();
+    vector<int> lens(size), displs(size);
+    MPI_Gather(&len, 1, MPI_INT, lens.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    string all;
+    if (rank == 0) {
+        int total = 0;
+        for (int r = 0; r < size; r++) {
+            displs[r] = total;
+            total += lens[r];
+        }
+        all.resize(total);
+    }
+    MPI_Gatherv(report.data(), len, MPI_CHAR, &all[0], lens.data(), displs.data(), MPI_CHAR, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) cout << all;
+}
+
 int main(int argc, char** argv) {
     // Fixed file names
-    string input_file = "input.csv";
 
 
 
@@ -58,84 +126,259 @@ int main(int argc, char** argv) {
     MPI_Comm_rank(MPI_COMM_WORLD, &rank); // Get current process rank
     MPI_Comm_size(MPI_COMM_WORLD, &size); // Get total number of processes
 
-    vector<vector<int>> graph; // Adjacency matrix
-    int V; // Number of vertices
+    // Command-line options, see prim_options.h (--compact keeps one live list
+    // of key slots, shared by the ranks of a grid row)
+    PrimOptions opts;
+    string error;
+    if (!parse_prim_options(argc, argv, opts, error)) {
+        if (rank == 0) cerr << "Error: " << error << "\n";
+        MPI_Finalize();
+        return 1;
+    }
+
+    vector<vector<int>> graph; // Adjacency matrix (rank 0 only, freed once the tiles are out)
+    int V = 0; // Number of vertices
 
+    // Rank 0 loads the whole graph (CSV or compressed)
+    int loaded = 1;
     if (rank == 0) {
-        graph = read_csv(input_file); 
-        V = graph.size();             
+        if (is_compressed_graph(opts.input_file)) loaded = read_compressed_graph(opts.input_file, graph);
+        else graph = read_csv(opts.input_file);
+        V = graph.size();
+    }
+    MPI_Bcast(&loaded, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (!loaded) {
+        if (rank == 0) cerr << "Error: " << opts.input_file << " is not a valid compressed graph\n";
+        MPI_Finalize();
+        return 1;
     }
-
-    
     MPI_Bcast(&V, 1, MPI_INT, 0, MPI_COMM_WORLD);
 
-    // All other processes resize their graph
-    if (rank != 0) graph.resize(V, vector<int>(V));
-
-    // Broadcast the entire graph to all processes
-    for (int i = 0; i < V; i++)
-        MPI_Bcast(graph[i].data(), V, MPI_INT, 0, MPI_COMM_WORLD);
+    // 2-D process grid, prow x pcol (sqrt(p) x sqrt(p) when p is a perfect square)
+    int dims[2] = {0, 0};
+    MPI_Dims_create(size, 2, dims);
+    int prow = dims[0], pcol = dims[1];
+    int my_row = rank / pcol, my_col = rank % pcol;
+
+    // row_comm: the ranks of my grid row, which share my key vertices (rank in it = my_col)
+    // col_comm: the ranks of my grid column, which share my source vertices (rank in it = my_row)
+    MPI_Comm row_comm, col_comm;
+    MPI_Comm_split(MPI_COMM_WORLD, my_row, my_col, &row_comm);
+    MPI_Comm_split(MPI_COMM_WORLD, my_col, my_row, &col_comm);
+
+    // Key vertices: whose key/parent this rank maintains, block-cyclic over grid rows.
+    // Source vertices: whose outgoing edges (to the key vertices) this rank stores,
+    // block-cyclic over grid columns. The tile is about V/prow x V/pcol.
+    vector<int> keys = cyclic_indices(V, opts.block, prow, my_row);
+    vector<int> sources = cyclic_indices(V, opts.block, pcol, my_col);
+    int nk = keys.size(), ns = sources.size();
+    vector<int> key_slot(V, -1), source_slot(V, -1); // global vertex -> local index, -1 if not mine
+    for (int b = 0; b < nk; b++) key_slot[keys[b]] = b;
+    for (int a = 0; a < ns; a++) source_slot[sources[a]] = a;
+
+    vector<int> tile((size_t) ns * nk);
+    scatter_tiles(graph, tile, V, opts.block, prow, pcol, rank, size);
+
+    vector<int> parent(V, -1); // Full parent array, assembled after the loop
+
+    vector<int> key(nk, INF); // Keys of my key vertices
+
+    vector<int> key_parent(nk, -1); // Parents of my key vertices
+
+    vector<char> inMST(nk, 0);
+    if (key_slot[0] != -1) key[key_slot[0]] = 0; // Start from vertex 0
+
+    // Live key slots: live[0..nlive) not in MST, pos[b] = slot of b in live
+    vector<int> live(nk), pos(nk);
+    for (int b = 0; b < nk; b++) {
+        live[b] = b;
+        pos[b] = b;
+    }
+    int nlive = nk;
 
-  
-    vector<int> parent(V, -1);    
+    // Weights from the vertex just added to my key vertices (to the live ones with --compact)
+    vector<int> urow(nk);
 
-    vector<int> key(V, INF);   
+    PerfProfile prof;
+    if (opts.profile) {
+        prof.init(omp_get_max_threads());
+        #pragma omp parallel
+        prof.open_thread(omp_get_thread_num());
+    }
 
-    vector<bool> inMST(V, false); 
-    key[0] = 0;                    // Start from vertex 0
+    // Result cache: rank 0 hashes the graph it loaded and tells the others whether to skip the loop
+    MstCache cache(opts.cache_dir);
+    uint64_t cache_key = 0;
+    long long total_weight = 0;
+    int cached = 0;
+    if (opts.use_cache) {
+        if (rank == 0) {
+            MstCacheResult r = report_cache_lookup(cache, graph, "hybrid;root=0;inf=" + to_string(INF), parent, total_weight);
+            cache_key = r.key;
+            cached = r.hit;
+        }
+        MPI_Bcast(&cached, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    }
+    vector<vector<int>>().swap(graph); // From here on every rank works from its tile only
 
     double start = MPI_Wtime(); // Start timing
 
     // Repeat until all vertices are included in MST
-    for (int count = 0; count < V - 1; count++) {
+    for (int count = 0; count < V - 1 && !cached; count++) {
         int local_min = INF, u = -1;
 
-        // Step 1: Local process finds minimum key vertex not in MST
+        // Step 1: the ranks of a grid row split its key vertices, their threads split them again
         #pragma omp parallel
         {
+            int tid = omp_get_thread_num();
             int tmin = INF, tu = -1;
 
-            // Divide vertex search among OpenMP threads and MPI processes
-            #pragma omp for nowait
-            for (int i = rank; i < V; i += size) {
-                if (!inMST[i] && key[i] < tmin) {
-                    tmin = key[i];
-                    tu = i;
+            prof.begin(tid);
+            if (opts.compact) {
+                #pragma omp for nowait
+                for (int i = my_col; i < nlive; i += pcol) {
+                    int b = live[i];
+                    if (key[b] < tmin || (key[b] == tmin && keys[b] < tu)) {
+                        tmin = key[b];
+                        tu = keys[b];
+                    }
+                }
+            } else {
+                #pragma omp for nowait
+                for (int b = my_col; b < nk; b += pcol) {
+                    if (!inMST[b] && key[b] < tmin) {
+                        tmin = key[b];
+                        tu = keys[b];
+                    }
                 }
             }
+            prof.end(tid, PHASE_SELECT);
 
-            // Use critical section to update process-local minimum
+            // Use critical section to update process-local minimum (ties go to the lowest vertex)
+            prof.begin(tid);
             #pragma omp critical
             {
-                if (tmin < local_min) {
+                if (tu != -1 && (tmin < local_min || (tmin == local_min && tu < u))) {
                     local_min = tmin;
                     u = tu;
                 }
             }
+            prof.end(tid, PHASE_REDUCE);
+            prof.barrier(tid);
+        }
+
+        // Wait for the other ranks separately, so the reduction below is timed on its own
+        if (opts.profile) {
+            double t0 = MPI_Wtime();
+            MPI_Barrier(MPI_COMM_WORLD);
+            prof.add_wait(0, MPI_Wtime() - t0);
         }
 
-        // Step 2: Global reduction to find process with global minimum key
+        // Step 2: two-stage argmin, along the grid row (my key vertices), then the grid column (all of them)
         struct {
             int val;
             int idx;
-        } local_pair = {local_min, u}, global_pair;
+        } local_pair = {local_min, u}, row_pair, global_pair;
 
-        MPI_Allreduce(&local_pair, &global_pair, 1, MPI_2INT, MPI_MINLOC, MPI_COMM_WORLD);
+        prof.begin(0);
+        MPI_Allreduce(&local_pair, &row_pair, 1, MPI_2INT, MPI_MINLOC, row_comm);
+        MPI_Allreduce(&row_pair, &global_pair, 1, MPI_2INT, MPI_MINLOC, col_comm);
+        prof.end(0, PHASE_REDUCE);
+        if (global_pair.val == INF) break; // Nothing left that is reachable
         u = global_pair.idx;      // Chosen global minimum vertex
-        inMST[u] = true;          // Mark it included
-
-        // Step 3: Update key and parent arrays in parallel
-        #pragma omp parallel for
-        for (int v = 0; v < V; v++) {
-          
-            if (graph[u][v] && !inMST[v] && graph[u][v] < key[v]) {
-                            key[v] = graph[u][v];
-                parent[v] = u;
+
+        // Only the grid row owning u has it among its key vertices
+        int ub = key_slot[u];
+        if (ub != -1) {
+            inMST[ub] = 1;          // Mark it included
+            // Swap the last live slot into u's slot
+            int last = live[--nlive];
+            live[pos[ub]] = last;
+            pos[last] = pos[ub];
+        }
+
+        // Step 3: the rank of my grid row that stores u's edges sends its tile row along the row
+        int owner = cyclic_owner(u, opts.block, pcol);
+        int n = opts.compact ? nlive : nk;
+        int* row = urow.data();
+
+        prof.begin(0);
+        if (my_col == owner) {
+            int* seg = tile.data() + (size_t) source_slot[u] * nk;
+            if (opts.compact) {
+                for (int i = 0; i < nlive; i++) urow[i] = seg[live[i]];
+            } else {
+                row = seg;
+            }
+        }
+        MPI_Bcast(row, n, MPI_INT, owner, row_comm);
+        prof.end(0, PHASE_RELAX);
+
+        // Step 4: Update key and parent of my key vertices in parallel
+        #pragma omp parallel
+        {
+            int tid = omp_get_thread_num();
+
+            prof.begin(tid);
+            if (opts.compact) {
+                #pragma omp for nowait
+                for (int i = 0; i < nlive; i++) {
+                    int b = live[i];
+                    if (row[i] && row[i] < key[b]) {
+                        key[b] = row[i];
+                        key_parent[b] = u;
+                    }
+                }
+            } else {
+                #pragma omp for nowait
+                for (int b = 0; b < nk; b++) {
+                    if (row[b] && !inMST[b] && row[b] < key[b]) {
+                        key[b] = row[b];
+                        key_parent[b] = u;
+                    }
+                }
             }
+            prof.end(tid, PHASE_RELAX);
+            prof.barrier(tid);
         }
     }
 
+    // Every rank needs the whole parent array: from the cache on a hit,
+    // otherwise each grid row contributes its key vertices
+    if (cached) {
+        MPI_Bcast(parent.data(), V, MPI_INT, 0, MPI_COMM_WORLD);
+    } else {
+        for (int b = 0; b < nk; b++) parent[keys[b]] = key_parent[b];
+        MPI_Allreduce(MPI_IN_PLACE, parent.data(), V, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    }
+
+    // Tree edge weights, read from whichever tile holds them:
+    // forward[v] = graph[parent[v]][v], backward[v] = graph[v][parent[v]]
+    vector<int> forward(V, numeric_limits<int>::max()), backward(V, numeric_limits<int>::max());
+    for (int b = 0; b < nk; b++) {
+        int p = parent[keys[b]];
+        if (p >= 0 && source_slot[p] != -1) forward[keys[b]] = tile[(size_t) source_slot[p] * nk + b];
+    }
+    for (int a = 0; a < ns; a++) {
+        int p = parent[sources[a]];
+        if (p >= 0 && key_slot[p] != -1) backward[sources[a]] = tile[(size_t) a * nk + key_slot[p]];
+    }
+    MPI_Reduce(rank == 0 ? MPI_IN_PLACE : forward.data(), forward.data(), V, MPI_INT, MPI_MIN, 0, MPI_COMM_WORLD);
+    MPI_Reduce(rank == 0 ? MPI_IN_PLACE : backward.data(), backward.data(), V, MPI_INT, MPI_MIN, 0, MPI_COMM_WORLD);
+    for (int v = 0; v < V; v++)
+        if (parent[v] < 0) forward[v] = 0;
+
+    if (opts.use_cache && !cached && rank == 0) {
+        total_weight = 0;
+        for (int v = 0; v < V; v++) total_weight += forward[v];
+        if (!cache.store(cache_key, parent, total_weight))
+            cerr << "Warning: could not write cache entry to " << opts.cache_dir << "\n";
+    }
 
+    if (opts.profile) print_rank_reports(prof.report("rank " + to_string(rank), V - 1), rank, size);
+
+    MPI_Comm_free(&row_comm);
+    MPI_Comm_free(&col_comm);
 
     // the MST to output file
     if (rank == 0) {
@@ -144,8 +387,9 @@ int main(int argc, char** argv) {
 
         for (int i = 1; i < V; i++) {
             int u = parent[i], v = i;
-            mst[u][v] = graph[u][v];
-            mst[v][u] = graph[v][u]; // Undirected graph
+            if (u < 0) continue; // Not reachable from vertex 0
+            mst[u][v] = forward[v];
+            mst[v][u] = backward[v]; // Undirected graph
         }
 
         // Save MST matrix to CSV file
@@ -156,9 +400,11 @@ int main(int argc, char** argv) {
 
        int total_threads = size * omp_get_max_threads();
         // Log performance results
-        ofstream log("log_time.txt", ios::app);
-        log << "MPI+OpenMP," << V << "," << total_threads << "," << duration << "\n";
-        log.close();
+        if (should_log_time(opts, cached)) {
+            ofstream log("log_time.txt", ios::app);
+            log << "MPI+OpenMP," << V << "," << total_threads << "," << duration << "\n";
+            log.close();
+        }
 
 
 
@@ -166,10 +412,14 @@ cout << "Execution time: " << duration << " seconds" << endl;
 cout << "Vertices: " << V << endl;
 
 cout << "Processes used (MPI): " << size << endl;
+cout << "Process grid: " << prow << " x " << pcol << " (block " << opts.block << ")" << endl;
 
 cout << "Threads per process (OpenMP): " << omp_get_max_threads() << endl;
 cout << "Output saved to: " << output_file << endl;
 
+        // Single-linkage clustering on the finished tree
+        if (!opts.cluster_queries.empty()) run_cluster_queries("hybrid", parent, forward, opts.cluster_queries, opts.cluster_binary);
+
 
 
     }
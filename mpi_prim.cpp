@@ -4,12 +4,17 @@
 #include <vector>
 #include <string>
 #include <limits>
+#include <algorithm>
+#include "prim_perf.h"
+#include "graph_codec.h"
+#include "mst_cache.h"
+#include "mst_cluster.h"
+#include "prim_options.h"
 
 #define INF 9999
 
 using namespace std;
 // File paths (update these if needed)
-const string INPUT_FILE = "input.csv";
 const string OUTPUT_FILE = "mpi_output.csv";
 const string LOG_FILE = "log_time.txt";
 
@@ -45,6 +50,89 @@ void write_csv(const vector<vector<int>>& mat, const string& filename) {
     }
 }
 
+// Broadcasts the raw bytes of a compressed graph from rank 0. Each rank decodes
+// a contiguous share of the blocks, then the decoded rows are exchanged with
+// MPI_Allgatherv, so the decoding work is split across the ranks.
+bool bcast_compressed_graph(vector<char>& packed, vector<vector<int>>& graph, int rank, int size) {
+    long long n = packed.size();
+    MPI_Bcast(&n, 1, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+    if (rank != 0) packed.resize(n);
+
+    // MPI counts are int, so large files go out in 1 GiB pieces
+    const long long CHUNK = 1LL << 30;
+    for (long long off = 0; off < n; off += CHUNK)
+        MPI_Bcast(packed.data() + off, (int) min(CHUNK, n - off), MPI_CHAR, 0, MPI_COMM_WORLD);
+
+    // Every rank holds the same bytes, so they all agree on a bad header
+    PmbHeader h;
+    vector<PmbIndexEntry> index;
+    if (!read_compressed_header(packed, h, index)) return false;
+    int V = h.vertices;
+    graph.assign(V, vector<int>());
+
+    // Rows [row_lo[r], row_lo[r + 1]) come from the blocks decoded by rank r
+    vector<int> row_lo(size + 1);
+    for (int r = 0; r <= size; r++)
+        row_lo[r] = min(V, (int) ((long long) h.blocks * r / size) * h.rows_per_block);
+    int ok = decode_compressed_blocks(packed, h, index, (long long) h.blocks * rank / size,
+                                      (long long) h.blocks * (rank + 1) / size, graph);
+    MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+    if (!ok) return false;
+
+    // Exchange a few rows per rank per round, keeping each round well under the int count limit
+    const long long ROUND_INTS = 1LL << 26;
+    int rows_per_round = max(1LL, ROUND_INTS / max(1LL, (long long) V * size));
+    int most_rows = 0;
+    for (int r = 0; r < size; r++) most_rows = max(most_rows, row_lo[r + 1] - row_lo[r]);
+
+    vector<int> counts(size), displs(size), sendbuf, recvbuf;
+    for (int j = 0; j < most_rows; j += rows_per_round) {
+        int total = 0;
+        for (int r = 0; r < size; r++) {
+            int rows = max(0, min(rows_per_round, row_lo[r + 1] - row_lo[r] - j));
+            counts[r] = rows * V;
+            displs[r] = total;
+            total += counts[r];
+        }
+
+        sendbuf.resize(counts[rank]);
+        for (int k = 0; k < counts[rank] / max(1, V); k++)
+            copy(graph[row_lo[rank] + j + k].begin(), graph[row_lo[rank] + j + k].end(), sendbuf.begin() + (size_t) k * V);
+        recvbuf.resize(total);
+        MPI_Allgatherv(sendbuf.data(), counts[rank], MPI_INT, recvbuf.data(), counts.data(), displs.data(),
+                       MPI_INT, MPI_COMM_WORLD);
+
+        for (int r = 0; r < size; r++) {
+            if (r == rank) continue;
+            for (int k = 0; k < counts[r] / max(1, V); k++) {
+                const int* src = recvbuf.data() + displs[r] + (size_t) k * V;
+                graph[row_lo[r] + j + k].assign(src, src + V);
+            }
+        }
+    }
+    return true;
+}
+
+// Collects each rank's profile report on rank 0 and prints them in rank order
+void print_rank_reports(const string& report, int rank, int size) {
+    int len = report.size();
+    vector<int> lens(size), displs(size);
+    MPI_Gather(&len, 1, MPI_INT, lens.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    string all;
+    if (rank == 0) {
+        int total = 0;
+        for (int r = 0; r < size; r++) {
+            displs[r] = total;
+            total += lens[r];
+        }
+        all.resize(total);
+    }
+    MPI_Gatherv(report.data(), len, MPI_CHAR, &all[0], lens.data(), displs.data(), MPI_CHAR, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) cout << all;
+}
+
 int main(int argc, char** argv){
 // Initialize MPI environment
  MPI_Init(&argc, &argv);
@@ -53,29 +141,56 @@ int main(int argc, char** argv){
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);  // Get current process ID
     MPI_Comm_size(MPI_COMM_WORLD, &size);  // Get total number of processes
 
+    // Command-line options, see prim_options.h
+    PrimOptions opts;
+    string error;
+    if (!parse_prim_options(argc, argv, opts, error)) {
+        if (rank == 0) cerr << "Error: " << error << "\n";
+        MPI_Finalize();
+        return 1;
+    }
+
     vector<vector<int>> graph;
     int V; // Number of vertices
 
-  // Rank 0 reads the input file and broadcasts to others
+  // Rank 0 reads the input file and broadcasts to others.
+  // A compressed file is broadcast as-is and the ranks decode it together.
+    vector<char> packed;
+    int compressed = 0;
     if (rank == 0) {
-        graph = read_csv(INPUT_FILE);
-        V = graph.size();
+        compressed = is_compressed_graph(opts.input_file);
+        if (compressed) {
+            read_file_bytes(opts.input_file, packed);
+        } else {
+            graph = read_csv(opts.input_file);
+            V = graph.size();
+        }
     }
+    MPI_Bcast(&compressed,1,MPI_INT,0,MPI_COMM_WORLD);
 
+    if (compressed) {
+        if (!bcast_compressed_graph(packed, graph, rank, size)) {
+            if (rank == 0) cerr << "Error: " << opts.input_file << " is not a valid compressed graph\n";
+            MPI_Finalize();
+            return 1;
+        }
+        packed.clear();
+        V = graph.size();
+    } else {
+        // Broadcast graph size to all processes
+        MPI_Bcast(&V,1,MPI_INT,0,MPI_COMM_WORLD);
 
-    // Broadcast graph size to all processes
-    MPI_Bcast(&V,1,MPI_INT,0,MPI_COMM_WORLD);
 
+        if (rank !=0)
+        {
+            graph.resize(V,vector<int>(V));
+        }
+        
 
-    if (rank !=0)
-    {
-        graph.resize(V,vector<int>(V));
+        // Broadcast the actual matrix row-by-row
+        for (int i = 0; i < V; i++)
+            MPI_Bcast(graph[i].data(),V,MPI_INT,0,MPI_COMM_WORLD);
     }
-    
-
-    // Broadcast the actual matrix row-by-row
-    for (int i = 0; i < V; i++)
-        MPI_Bcast(graph[i].data(),V,MPI_INT,0,MPI_COMM_WORLD);
 
     // Initialize Prims algorithm data structures
 
@@ -90,21 +205,70 @@ int main(int argc, char** argv){
 
     key[0] = 0;
 
+    // Live vertex set: live[0..nlive) not in MST, pos[v] = slot of v in live.
+    // Updates are deterministic, so the list stays identical on every rank.
+    vector<int> live(V), pos(V);
+    for (int v = 0; v < V; v++) {
+        live[v] = v;
+        pos[v] = v;
+    }
+    int nlive = V;
+
+    PerfProfile prof;
+    if (opts.profile) {
+        prof.init(1);
+        prof.open_thread(0);
+    }
+
+    // Result cache: rank 0 hashes the graph it loaded and tells the others whether to skip the loop
+    MstCache cache(opts.cache_dir);
+    uint64_t cache_key = 0;
+    long long total_weight = 0;
+    int cached = 0;
+    if (opts.use_cache) {
+        if (rank == 0) {
+            MstCacheResult r = report_cache_lookup(cache, graph, "mpi;root=0;inf=" + to_string(INF), parent, total_weight);
+            cache_key = r.key;
+            cached = r.hit;
+        }
+        MPI_Bcast(&cached, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    }
+
     // start time measurement
     double start = MPI_Wtime();
     
 
 
-for (int count = 0; count < V - 1; count++) {
+for (int count = 0; count < V - 1 && !cached; count++) {
         int local_min = INF, u = -1;
 
-        // Each process checks its own subset of vertices
-        for (int i = rank; i < V; i += size) {
-            if (!inMST[i] && key[i] < local_min) {
-                local_min = key[i];
-                u = i;
+        prof.begin(0);
+        if (opts.compact) {
+            // Each process checks its own stride of the live slots
+            for (int i = rank; i < nlive; i += size) {
+                int v = live[i];
+                if (key[v] < local_min || (key[v] == local_min && v < u)) {
+                    local_min = key[v];
+                    u = v;
+                }
+            }
+        } else {
+            // Each process checks its own subset of vertices
+            for (int i = rank; i < V; i += size) {
+                if (!inMST[i] && key[i] < local_min) {
+                    local_min = key[i];
+                    u = i;
+                }
             }
         }
+        prof.end(0, PHASE_SELECT);
+
+        // Time spent waiting for slower ranks is split out from the reduction itself
+        if (opts.profile) {
+            double t0 = MPI_Wtime();
+            MPI_Barrier(MPI_COMM_WORLD);
+            prof.add_wait(0, MPI_Wtime() - t0);
+        }
 
         // Find the global minimum vertex not in MST
         struct {
@@ -112,11 +276,33 @@ for (int count = 0; count < V - 1; count++) {
             int idx;
         } local_pair = {local_min, u}, global_pair;
 
+        prof.begin(0);
         MPI_Allreduce(&local_pair, &global_pair, 1, MPI_2INT, MPI_MINLOC, MPI_COMM_WORLD);
+        prof.end(0, PHASE_REDUCE);
 
         u = global_pair.idx;
         inMST[u] = true;
 
+        prof.begin(0);
+
+        if (opts.compact) {
+            // Drop u from the live set and relax only the remaining live vertices
+            int last = live[--nlive];
+            live[pos[u]] = last;
+            pos[last] = pos[u];
+
+            const vector<int>& row = graph[u];
+            for (int i = 0; i < nlive; i++) {
+                int v = live[i];
+                if (row[v] && row[v] < key[v]) {
+                    key[v] = row[v];
+                    parent[v] = u;
+                }
+            }
+            prof.end(0, PHASE_RELAX);
+            continue;
+        }
+
         // Update key and parent of the adjacent vertices
         for (int v = 0; v < V; v++) {
             if (graph[u][v] && !inMST[v] && graph[u][v] < key[v]) {
@@ -124,8 +310,17 @@ for (int count = 0; count < V - 1; count++) {
                 parent[v] = u;
             }
         }
+        prof.end(0, PHASE_RELAX);
     }
 
+    if (opts.use_cache && !cached && rank == 0) {
+        total_weight = mst_total_weight(graph, parent);
+        if (!cache.store(cache_key, parent, total_weight))
+            cerr << "Warning: could not write cache entry to " << opts.cache_dir << "\n";
+    }
+
+    if (opts.profile) print_rank_reports(prof.report("rank " + to_string(rank), V - 1), rank, size);
+
  // Only rank 0 writes the result
     if (rank == 0) {
         vector<vector<int>> mst(V, vector<int>(V, INF));
@@ -146,12 +341,17 @@ for (int count = 0; count < V - 1; count++) {
         double duration = end - start;
 
         // Log format: MPI,Vertices,Processes,Time
-        ofstream log(LOG_FILE, ios::app);
-        log << "MPI," << V << "," << size << "," << duration << "\n";
-        log.close();
+        if (should_log_time(opts, cached)) {
+            ofstream log(LOG_FILE, ios::app);
+            log << "MPI," << V << "," << size << "," << duration << "\n";
+            log.close();
+        }
           cout << "Execution time: " << duration << " seconds\n";
     cout << "Number of processes: " << size << "\n";
     cout << "Output file: " << OUTPUT_FILE << "\n";
+
+        // Single-linkage clustering on the finished tree
+        if (!opts.cluster_queries.empty()) run_cluster_queries("mpi", parent, mst_edge_weights(graph, parent), opts.cluster_queries, opts.cluster_binary);
     }
 
     // Finalize MPI
@@ -0,0 +1,191 @@
+// Content-addressed cache of MST results (--cache).
+//
+// The key is an XXH64 hash of the adjacency matrix and the engine
+// parameters (backend name, root vertex, INF). An entry stores the parent
+// array and total weight in <dir>/<key>.mst, so a repeated run on an
+// unchanged input skips the O(V^2) Prim loop.
+#pragma once
+
+#include <sys/stat.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define MST_CACHE_DIR ".mst_cache"
+#define MST_CACHE_MAGIC "PMST"
+
+// ---- XXH64 (reference algorithm, little-endian loads) ----
+
+static const uint64_t XXH_PRIME1 = 11400714785074694791ULL;
+static const uint64_t XXH_PRIME2 = 14029467366897019727ULL;
+static const uint64_t XXH_PRIME3 = 1609587929392839161ULL;
+static const uint64_t XXH_PRIME4 = 9650029242287828579ULL;
+static const uint64_t XXH_PRIME5 = 2870177450012600261ULL;
+
+inline uint64_t xxh_rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t xxh_read64(const uint8_t* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+inline uint32_t xxh_read32(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+
+inline uint64_t xxh_round(uint64_t acc, uint64_t input) {
+    acc += input * XXH_PRIME2;
+    acc = xxh_rotl(acc, 31);
+    return acc * XXH_PRIME1;
+}
+
+inline uint64_t xxh_merge(uint64_t acc, uint64_t val) {
+    acc ^= xxh_round(0, val);
+    return acc * XXH_PRIME1 + XXH_PRIME4;
+}
+
+inline uint64_t xxh64(const void* data, size_t len, uint64_t seed) {
+    const uint8_t* p = (const uint8_t*) data;
+    const uint8_t* end = p + len;
+    uint64_t h;
+
+    if (len >= 32) {
+        uint64_t v1 = seed + XXH_PRIME1 + XXH_PRIME2;
+        uint64_t v2 = seed + XXH_PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XXH_PRIME1;
+        do {
+            v1 = xxh_round(v1, xxh_read64(p));
+            v2 = xxh_round(v2, xxh_read64(p + 8));
+            v3 = xxh_round(v3, xxh_read64(p + 16));
+            v4 = xxh_round(v4, xxh_read64(p + 24));
+            p += 32;
+        } while (p + 32 <= end);
+        h = xxh_rotl(v1, 1) + xxh_rotl(v2, 7) + xxh_rotl(v3, 12) + xxh_rotl(v4, 18);
+        h = xxh_merge(h, v1);
+        h = xxh_merge(h, v2);
+        h = xxh_merge(h, v3);
+        h = xxh_merge(h, v4);
+    } else {
+        h = seed + XXH_PRIME5;
+    }
+
+    h += (uint64_t) len;
+    for (; p + 8 <= end; p += 8) {
+        h ^= xxh_round(0, xxh_read64(p));
+        h = xxh_rotl(h, 27) * XXH_PRIME1 + XXH_PRIME4;
+    }
+    if (p + 4 <= end) {
+        h ^= (uint64_t) xxh_read32(p) * XXH_PRIME1;
+        h = xxh_rotl(h, 23) * XXH_PRIME2 + XXH_PRIME3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h ^= (*p) * XXH_PRIME5;
+        h = xxh_rotl(h, 11) * XXH_PRIME1;
+    }
+
+    h ^= h >> 33;
+    h *= XXH_PRIME2;
+    h ^= h >> 29;
+    h *= XXH_PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+// ---- cache ----
+
+// Outcome of a lookup, printed by the caller
+struct MstCacheResult {
+    bool hit = false;
+    uint64_t key = 0;
+    double seconds = 0;
+};
+
+class MstCache {
+public:
+    explicit MstCache(const std::string& dir = MST_CACHE_DIR) : dir(dir) {}
+
+    // Hashes the matrix row by row (each row seeded with the running hash)
+    // and folds in the engine parameters, e.g. "serial;root=0;inf=9999"
+    static uint64_t make_key(const std::vector<std::vector<int>>& graph, const std::string& params) {
+        uint64_t h = xxh64(params.data(), params.size(), graph.size());
+        for (const auto& row : graph) h = xxh64(row.data(), row.size() * sizeof(int), h);
+        return h;
+    }
+
+    // Hashes graph + params and loads the matching parent[] and total_weight.
+    // The reported time covers hashing and reading the entry.
+    MstCacheResult lookup(const std::vector<std::vector<int>>& graph, const std::string& params,
+                          std::vector<int>& parent, long long& total_weight) const {
+        auto t0 = std::chrono::steady_clock::now();
+        MstCacheResult r;
+        r.key = make_key(graph, params);
+
+        int32_t V = graph.size();
+        std::ifstream fin(path(r.key), std::ios::binary);
+        char magic[4];
+        int32_t n = -1;
+        if (fin.read(magic, 4) && memcmp(magic, MST_CACHE_MAGIC, 4) == 0 &&
+            fin.read((char*) &n, sizeof(n)) && n == V &&
+            fin.read((char*) &total_weight, sizeof(total_weight))) {
+            std::vector<int> p(V);
+            bool valid = (bool) fin.read((char*) p.data(), V * sizeof(int));
+            for (int i = 0; valid && i < V; i++) valid = p[i] >= -1 && p[i] < V;
+            if (valid) {
+                parent.swap(p);
+                r.hit = true;
+            }
+        }
+
+        r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        return r;
+    }
+
+    // Writes an entry atomically (temp file + rename) so readers never see half a file
+    bool store(uint64_t key, const std::vector<int>& parent, long long total_weight) const {
+        mkdir(dir.c_str(), 0755);
+        std::string final_path = path(key);
+        std::string tmp_path = final_path + ".tmp";
+
+        std::ofstream fout(tmp_path, std::ios::binary);
+        int32_t n = parent.size();
+        fout.write(MST_CACHE_MAGIC, 4);
+        fout.write((const char*) &n, sizeof(n));
+        fout.write((const char*) &total_weight, sizeof(total_weight));
+        fout.write((const char*) parent.data(), parent.size() * sizeof(int));
+        fout.close();
+        if (!fout) {
+            remove(tmp_path.c_str());
+            return false;
+        }
+        return rename(tmp_path.c_str(), final_path.c_str()) == 0;
+    }
+
+    static std::string key_hex(uint64_t key) {
+        char buf[17];
+        snprintf(buf, sizeof(buf), "%016llx", (unsigned long long) key);
+        return buf;
+    }
+
+private:
+    std::string dir;
+
+    std::string path(uint64_t key) const { return dir + "/" + key_hex(key) + ".mst"; }
+};
+
+// Looks graph + params up and prints the "Cache hit|miss (key ...) in ... seconds" line
+inline MstCacheResult report_cache_lookup(const MstCache& cache, const std::vector<std::vector<int>>& graph,
+                                          const std::string& params, std::vector<int>& parent, long long& total_weight) {
+    MstCacheResult r = cache.lookup(graph, params, parent, total_weight);
+    std::cout << "Cache " << (r.hit ? "hit" : "miss") << " (key " << MstCache::key_hex(r.key)
+              << ") in " << r.seconds << " seconds\n";
+    return r;
+}
+
+// Total weight of the tree described by parent[] (edges parent[v] -> v)
+inline long long mst_total_weight(const std::vector<std::vector<int>>& graph, const std::vector<int>& parent) {
+    long long total = 0;
+    for (size_t v = 0; v < parent.size(); v++)
+        if (parent[v] >= 0) total += graph[parent[v]][v];
+    return total;
+}
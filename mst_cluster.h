@@ -0,0 +1,200 @@
+// Single-linkage clustering from the MST parent array (--clusters / --cut).
+//
+// Single-linkage clusters are the connected components left after removing
+// the heaviest tree edges, so the V-1 tree edges are sorted once and every
+// query is a union-find pass (union by size, path halving) over a prefix of
+// that order: O(V alpha(V)) per query instead of re-reading the V x V output matrix.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One clustering request: exactly k clusters, or cut at edge weight w
+struct ClusterQuery {
+    bool by_weight = false;
+    int value = 0;
+
+    std::string name() const { return (by_weight ? "w=" : "k=") + std::to_string(value); }
+};
+
+struct MstEdge {
+    int weight, u, v;
+};
+
+class Dendrogram {
+public:
+    // weight[v] is the weight of tree edge parent[v] -> v; roots and
+    // unreachable vertices (parent -1) contribute no edge
+    Dendrogram(const std::vector<int>& parent, const std::vector<int>& weight) : V(parent.size()) {
+        for (int v = 0; v < V; v++)
+            if (parent[v] >= 0) edges.push_back({weight[v], parent[v], v});
+        // Merge order of the dendrogram: lightest edge first, ties by vertex
+        std::sort(edges.begin(), edges.end(), [](const MstEdge& a, const MstEdge& b) {
+            return a.weight != b.weight ? a.weight < b.weight : a.v < b.v;
+        });
+    }
+
+    // Cluster label (0..k-1, numbered by lowest vertex) of every vertex
+    std::vector<int> labels(const ClusterQuery& q) const {
+        size_t merges;
+        if (q.by_weight) {
+            // Every edge with weight <= w is kept
+            merges = std::upper_bound(edges.begin(), edges.end(), q.value,
+                                      [](int w, const MstEdge& e) { return w < e.weight; }) - edges.begin();
+        } else {
+            // k clusters = V - k merges (a forest cannot go below V - edges clusters)
+            long long m = (long long) V - q.value;
+            merges = (size_t) std::max(0LL, std::min<long long>(m, edges.size()));
+        }
+        return labels_after(merges);
+    }
+
+    // Answers a batch of queries on worker threads (std::thread, so the
+    // serial and MPI builds get it too), each thread taking the next query
+    std::vector<std::vector<int>> labels(const std::vector<ClusterQuery>& queries) const {
+        std::vector<std::vector<int>> out(queries.size());
+        int n = queries.size();
+        int nthreads = std::min<int>(n, std::max(1u, std::thread::hardware_concurrency()));
+        std::atomic<int> next{0};
+        auto work = [&] {
+            for (int i; (i = next++) < n;) out[i] = labels(queries[i]);
+        };
+
+        std::vector<std::thread> pool;
+        for (int t = 1; t < nthreads; t++) pool.emplace_back(work);
+        work();
+        for (std::thread& t : pool) t.join();
+        return out;
+    }
+
+private:
+    int V;
+    std::vector<MstEdge> edges;
+
+    // Union-find over the first `merges` edges, then compact root ids to 0..k-1
+    std::vector<int> labels_after(size_t merges) const {
+        std::vector<int> up(V), size(V, 1);
+        for (int v = 0; v < V; v++) up[v] = v;
+
+        auto find = [&](int x) {
+            while (up[x] != x) {
+                up[x] = up[up[x]];  // path halving
+                x = up[x];
+            }
+            return x;
+        };
+
+        for (size_t i = 0; i < merges; i++) {
+            int a = find(edges[i].u), b = find(edges[i].v);
+            if (a == b) continue;
+            if (size[a] < size[b]) std::swap(a, b);  // union by size: smaller tree goes under
+            up[b] = a;
+            size[a] += size[b];
+        }
+
+        std::vector<int> label(V, -1), out(V);
+        int next = 0;
+        for (int v = 0; v < V; v++) {
+            int r = find(v);
+            if (label[r] == -1) label[r] = next++;
+            out[v] = label[r];
+        }
+        return out;
+    }
+};
+
+// Parses "3,10,25" into queries of one kind
+inline bool parse_cluster_queries(const std::string& text, bool by_weight, std::vector<ClusterQuery>& out) {
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        try {
+            ClusterQuery q;
+            q.by_weight = by_weight;
+            size_t end;
+            q.value = std::stoi(item, &end);
+            if (end != item.size()) return false;  // trailing characters, e.g. "3x"
+            if (!by_weight && q.value < 1) return false;
+            out.push_back(q);
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Weight of each tree edge parent[v] -> v, taken from the adjacency matrix
+inline std::vector<int> mst_edge_weights(const std::vector<std::vector<int>>& graph, const std::vector<int>& parent) {
+    std::vector<int> w(parent.size(), 0);
+    for (size_t v = 0; v < parent.size(); v++)
+        if (parent[v] >= 0) w[v] = graph[parent[v]][v];
+    return w;
+}
+
+// Writes one label column per query.
+//   CSV:    header "vertex,k=3,w=25", then one row per vertex
+//   binary: int32 V, int32 nqueries, then nqueries x V int32 labels
+inline bool write_clusters(const std::string& path, const std::vector<ClusterQuery>& queries,
+                           const std::vector<std::vector<int>>& labels, bool binary) {
+    std::ofstream fout(path, binary ? std::ios::binary : std::ios::out);
+    if (!fout.is_open()) return false;
+    int32_t V = labels.empty() ? 0 : labels[0].size();
+
+    if (binary) {
+        int32_t n = queries.size();
+        fout.write((const char*) &V, sizeof(V));
+        fout.write((const char*) &n, sizeof(n));
+        for (const auto& l : labels) fout.write((const char*) l.data(), l.size() * sizeof(int));
+        return (bool) fout;
+    }
+
+    fout << "vertex";
+    for (const auto& q : queries) fout << "," << q.name();
+    fout << "\n";
+    for (int v = 0; v < V; v++) {
+        fout << v;
+        for (const auto& l : labels) fout << "," << l[v];
+        fout << "\n";
+    }
+    return (bool) fout;
+}
+
+// Outcome of cluster_mst(), printed by the caller
+struct ClusterRun {
+    bool ok = false;
+    std::string path;
+    double seconds = 0;
+};
+
+// Builds the dendrogram, answers every query and writes <prefix>_clusters.csv (or .bin)
+inline ClusterRun cluster_mst(const std::string& prefix, const std::vector<int>& parent, const std::vector<int>& weight,
+                              const std::vector<ClusterQuery>& queries, bool binary) {
+    auto t0 = std::chrono::steady_clock::now();
+    ClusterRun run;
+    run.path = prefix + (binary ? "_clusters.bin" : "_clusters.csv");
+
+    Dendrogram tree(parent, weight);
+    run.ok = write_clusters(run.path, queries, tree.labels(queries), binary);
+
+    run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return run;
+}
+
+// Runs the queries (if any) and prints the "Clusters: ..." line, or an error if the file could not be written
+inline bool run_cluster_queries(const std::string& prefix, const std::vector<int>& parent, const std::vector<int>& weight,
+                                const std::vector<ClusterQuery>& queries, bool binary) {
+    if (queries.empty()) return true;
+    ClusterRun cr = cluster_mst(prefix, parent, weight, queries, binary);
+    if (cr.ok) std::cout << "Clusters: " << queries.size() << " queries in " << cr.seconds << " seconds -> " << cr.path << "\n";
+    else std::cerr << "Error: could not write " << cr.path << "\n";
+    return cr.ok;
+}
@@ -0,0 +1,490 @@
+#include <sys/socket.h>   // Unix domain sockets
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <deque>
+#include <set>
+#include <unordered_set>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include "graph_codec.h"  // Compressed block graph format
+
+#define INF 9999          // Represent infinity (no edge)
+#define HIST_BUCKETS 32   // Latency histogram buckets: [2^(k-1), 2^k) microseconds
+
+using namespace std;
+
+// Long-running MST server: loads the graph once, then answers queries over a
+// Unix domain socket. One request per line, one response line per request:
+//
+//   MST [root=R] [mask=a-b,c,...] [max_weight=W] [exclude=u:v,...] [parents]
+//   STATS        latency histogram of all answered MST queries, plus the ERR count
+//   QUIT         close this connection
+//   SHUTDOWN     stop the server
+//
+// MST lines that arrive together are submitted as one batch to the worker
+// pool; responses come back in request order.
+
+const string INPUT_FILE = "input.csv";
+const string SOCKET_PATH = "mst_server.sock";
+
+// Reads a CSV file into a 2D adjacency matrix
+vector<vector<int>> read_csv(const string& filename) {
+    ifstream fin(filename);
+    string line;
+    vector<vector<int>> matrix;
+
+    while (getline(fin, line)) {
+        vector<int> row;
+        size_t pos;
+        while ((pos = line.find(',')) != string::npos) {
+            row.push_back(stoi(line.substr(0, pos)));
+            line.erase(0, pos + 1);
+        }
+        row.push_back(stoi(line));  // Add the last element
+        matrix.push_back(row);
+    }
+    return matrix;
+}
+
+// One parsed MST request
+struct Query {
+    int root = 0;
+    int max_weight = INF;           // heavier edges are ignored
+    vector<int> mask;               // allowed vertices, empty = all
+    vector<pair<int, int>> exclude; // edges that may not be used
+    bool want_parents = false;
+};
+
+// Undirected edge id for the exclusion set
+static inline uint64_t edge_id(int u, int v) {
+    if (u > v) swap(u, v);
+    return ((uint64_t) u << 32) | (uint32_t) v;
+}
+
+// Parses "a-b,c,..." (mask) into vertex ids
+bool parse_vertex_list(const string& text, int V, vector<int>& out) {
+    stringstream ss(text);
+    string item;
+    while (getline(ss, item, ',')) {
+        size_t dash = item.find('-');
+        int lo = stoi(item.substr(0, dash));
+        int hi = dash == string::npos ? lo : stoi(item.substr(dash + 1));
+        if (lo < 0 || hi >= V || lo > hi) return false;
+        for (int v = lo; v <= hi; v++) out.push_back(v);
+    }
+    return true;
+}
+
+// Parses "u:v,..." (exclude) into edges
+bool parse_edge_list(const string& text, int V, vector<pair<int, int>>& out) {
+    stringstream ss(text);
+    string item;
+    while (getline(ss, item, ',')) {
+        size_t colon = item.find(':');
+        if (colon == string::npos) return false;
+        int u = stoi(item.substr(0, colon));
+        int v = stoi(item.substr(colon + 1));
+        if (u < 0 || u >= V || v < 0 || v >= V) return false;
+        out.push_back({u, v});
+    }
+    return true;
+}
+
+bool parse_query(const string& line, int V, Query& q, string& err) {
+    stringstream ss(line);
+    string tok;
+    ss >> tok;  // "MST"
+    try {
+        while (ss >> tok) {
+            size_t eq = tok.find('=');
+            string name = tok.substr(0, eq);
+            string value = eq == string::npos ? "" : tok.substr(eq + 1);
+
+            if (name == "root") {
+                q.root = stoi(value);
+                if (q.root < 0 || q.root >= V) { err = "root out of range"; return false; }
+            } else if (name == "max_weight") {
+                q.max_weight = stoi(value);
+            } else if (name == "mask") {
+                if (!parse_vertex_list(value, V, q.mask)) { err = "bad mask"; return false; }
+            } else if (name == "exclude") {
+                if (!parse_edge_list(value, V, q.exclude)) { err = "bad exclude list"; return false; }
+            } else if (name == "parents") {
+                q.want_parents = true;
+            } else {
+                err = "unknown option " + name;
+                return false;
+            }
+        }
+    } catch (const exception&) {
+        err = "bad number in " + tok;
+        return false;
+    }
+    // The default root 0 is never range-checked above and does not exist in an empty graph
+    if (q.root >= V) { err = "root out of range"; return false; }
+    return true;
+}
+
+// Per-worker buffers, sized once and reused by every query
+struct Workspace {
+    vector<int> key, parent, live, pos;
+    vector<char> allowed;
+    unordered_set<uint64_t> excluded;
+};
+
+// Prim's algorithm from q.root over the allowed vertices and edges, using the
+// packed live-vertex set. Vertices the root cannot reach are left out.
+string run_query(const vector<vector<int>>& graph, const Query& q, Workspace& ws) {
+    int V = graph.size();
+    auto t0 = chrono::steady_clock::now();
+
+    ws.key.assign(V, INF);
+    ws.parent.assign(V, -1);
+    ws.allowed.assign(V, q.mask.empty());
+    for (int v : q.mask) ws.allowed[v] = 1;
+    if (!ws.allowed[q.root]) return "ERR root not in mask";
+
+    ws.excluded.clear();
+    for (const auto& e : q.exclude) ws.excluded.insert(edge_id(e.first, e.second));
+
+    int nlive = 0;
+    for (int v = 0; v < V; v++) {
+        if (!ws.allowed[v]) continue;
+        ws.live[nlive] = v;
+        ws.pos[v] = nlive++;
+    }
+
+    ws.key[q.root] = 0;
+    long long weight = 0;
+    int added = 0;
+
+    while (nlive > 0) {
+        int min = INF, u = -1;
+        for (int i = 0; i < nlive; i++) {
+            int v = ws.live[i];
+            if (ws.key[v] < min || (ws.key[v] == min && v < u)) {
+                min = ws.key[v];
+                u = v;
+            }
+        }
+        if (u == -1) break;  // the rest is unreachable from root
+
+        int last = ws.live[--nlive];
+        ws.live[ws.pos[u]] = last;
+        ws.pos[last] = ws.pos[u];
+        weight += min;
+        added++;
+
+        const vector<int>& row = graph[u];
+        for (int i = 0; i < nlive; i++) {
+            int v = ws.live[i];
+            int w = row[v];
+            if (w && w <= q.max_weight && w < ws.key[v] &&
+                (ws.excluded.empty() || !ws.excluded.count(edge_id(u, v)))) {
+                ws.key[v] = w;
+                ws.parent[v] = u;
+            }
+        }
+    }
+
+    double us = chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count();
+
+    ostringstream out;
+    out << "OK root=" << q.root << " vertices=" << added << " edges=" << (added ? added - 1 : 0)
+        << " weight=" << weight << " compute_us=" << (long long) us;
+    if (q.want_parents) {
+        out << " parents=";
+        for (int v = 0; v < V; v++) out << (v ? "," : "") << ws.parent[v];
+    }
+    return out.str();
+}
+
+// One request line travelling through the pool
+struct Job {
+    string line;
+    string response;
+    chrono::steady_clock::time_point queued;
+};
+
+// Completion counter for one submitted batch
+struct Batch {
+    mutex m;
+    condition_variable cv;
+    int pending = 0;
+};
+
+// Fixed set of workers, each with its own Workspace, fed from one queue
+class WorkerPool {
+public:
+    WorkerPool(const vector<vector<int>>& graph, int nworkers) : graph(graph) {
+        for (int i = 0; i < HIST_BUCKETS; i++) hist[i] = 0;
+        for (int i = 0; i < nworkers; i++) workers.emplace_back(&WorkerPool::work, this);
+    }
+
+    // Queues the whole batch at once and waits until every job has a response
+    void submit(vector<Job>& jobs) {
+        if (jobs.empty()) return;
+        Batch batch;
+        batch.pending = jobs.size();
+        {
+            lock_guard<mutex> lock(m);
+            auto now = chrono::steady_clock::now();
+            for (Job& j : jobs) {
+                j.queued = now;
+                queue.push_back({&j, &batch});
+            }
+        }
+        cv.notify_all();
+
+        unique_lock<mutex> lock(batch.m);
+        batch.cv.wait(lock, [&] { return batch.pending == 0; });
+    }
+
+    // Lets the workers drain the queue, then joins them
+    void stop() {
+        {
+            lock_guard<mutex> lock(m);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (thread& t : workers) t.join();
+        workers.clear();
+    }
+
+    // One-line summary of end-to-end query latency (queue wait + compute)
+    string stats() const {
+        uint64_t n = count;
+        ostringstream out;
+        out << "OK queries=" << n
+            << " errors=" << errors.load()
+            << " mean_us=" << (n ? total_us / n : 0)
+            << " max_us=" << max_us.load()
+            << " hist_us=";
+        bool first = true;
+        for (int b = 0; b < HIST_BUCKETS; b++) {
+            if (!hist[b]) continue;
+            out << (first ? "" : ",") << "<" << (1ull << b) << ":" << hist[b];
+            first = false;
+        }
+        return out.str();
+    }
+
+private:
+    const vector<vector<int>>& graph;
+    vector<thread> workers;
+    mutex m;
+    condition_variable cv;
+    deque<pair<Job*, Batch*>> queue;
+    bool stopping = false;
+
+    atomic<uint64_t> hist[HIST_BUCKETS];
+    atomic<uint64_t> count{0}, total_us{0}, max_us{0};
+    atomic<uint64_t> errors{0};  // ERR responses, kept out of the histogram
+
+    void work() {
+        Workspace ws;
+        ws.live.resize(graph.size());
+        ws.pos.resize(graph.size());
+
+        while (true) {
+            pair<Job*, Batch*> item;
+            {
+                unique_lock<mutex> lock(m);
+                cv.wait(lock, [&] { return stopping || !queue.empty(); });
+                if (queue.empty()) return;
+                item = queue.front();
+                queue.pop_front();
+            }
+
+            Job& job = *item.first;
+            Query q;
+            string err;
+            if (parse_query(job.line, graph.size(), q, err)) job.response = run_query(graph, q, ws);
+            else job.response = "ERR " + err;
+            if (job.response.compare(0, 3, "ERR") == 0) errors++;
+            else record(chrono::steady_clock::now() - job.queued);
+
+            Batch& batch = *item.second;
+            lock_guard<mutex> lock(batch.m);
+            if (--batch.pending == 0) batch.cv.notify_one();
+        }
+    }
+
+    void record(chrono::steady_clock::duration d) {
+        uint64_t us = chrono::duration_cast<chrono::microseconds>(d).count();
+        int b = 0;
+        while (b < HIST_BUCKETS - 1 && (us >> b)) b++;
+        hist[b]++;
+        count++;
+        total_us += us;
+        uint64_t prev = max_us;
+        while (us > prev && !max_us.compare_exchange_weak(prev, us)) {}
+    }
+};
+
+// Writes all of buf, ignoring a peer that has already gone away
+static void write_all(int fd, const string& buf) {
+    size_t off = 0;
+    while (off < buf.size()) {
+        ssize_t n = send(fd, buf.data() + off, buf.size() - off, MSG_NOSIGNAL);
+        if (n <= 0) return;
+        off += n;
+    }
+}
+
+// Serves one client: MST lines read in one chunk form one batch
+void serve_connection(int fd, WorkerPool& pool, atomic<bool>& shutting_down, int listen_fd) {
+    string buffer;
+    char chunk[65536];
+    bool open = true;
+
+    while (open) {
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n <= 0) break;
+        buffer.append(chunk, n);
+
+        vector<Job> batch;
+        string out;
+        size_t start = 0, nl;
+        while (open && (nl = buffer.find('\n', start)) != string::npos) {
+            string line = buffer.substr(start, nl - start);
+            start = nl + 1;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+
+            if (line.compare(0, 3, "MST") == 0) {
+                batch.push_back({line, "", {}});
+                continue;
+            }
+
+            // Control commands are answered in order, after the MST lines before them
+            pool.submit(batch);
+            for (const Job& j : batch) out += j.response + "\n";
+            batch.clear();
+
+            if (line == "STATS") {
+                out += pool.stats() + "\n";
+            } else if (line == "QUIT") {
+                open = false;
+            } else if (line == "SHUTDOWN") {
+                out += "OK shutting down\n";
+                shutting_down = true;
+                shutdown(listen_fd, SHUT_RDWR);  // wakes the accept loop
+                open = false;
+            } else {
+                out += "ERR unknown command\n";
+            }
+        }
+        buffer.erase(0, start);
+
+        pool.submit(batch);
+        for (const Job& j : batch) out += j.response + "\n";
+        write_all(fd, out);
+    }
+}
+
+int main(int argc, char** argv) {
+    // --input FILE: CSV or compressed (.pmb) graph
+    // --socket PATH: Unix socket to listen on
+    // --workers N: number of query workers (default: hardware threads)
+    string input_file = INPUT_FILE;
+    string socket_path = SOCKET_PATH;
+    int nworkers = thread::hardware_concurrency();
+    for (int i = 1; i < argc; i++) {
+        if (string(argv[i]) == "--input" && i + 1 < argc) input_file = argv[++i];
+        if (string(argv[i]) == "--socket" && i + 1 < argc) socket_path = argv[++i];
+        if (string(argv[i]) == "--workers" && i + 1 < argc) {
+            string value = argv[++i];
+            try {
+                nworkers = stoi(value);
+            } catch (const exception&) {
+                cerr << "Error: --workers expects a number, got " << value << "\n";
+                return 1;
+            }
+        }
+    }
+    if (nworkers < 1) nworkers = 1;
+
+    // Load the graph once; it stays resident for every query
+    vector<vector<int>> graph;
+    if (is_compressed_graph(input_file)) {
+        if (!read_compressed_graph(input_file, graph)) {
+            cerr << "Error: " << input_file << " is not a valid compressed graph\n";
+            return 1;
+        }
+    } else {
+        ifstream fin(input_file);
+        if (!fin.is_open()) {
+            cerr << "Error: cannot open input file " << input_file << "\n";
+            return 1;
+        }
+        graph = read_csv(input_file);
+    }
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(addr.sun_path)) {
+        cerr << "Error: socket path too long: " << socket_path << "\n";
+        return 1;
+    }
+    strcpy(addr.sun_path, socket_path.c_str());
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socket_path.c_str());  // stale socket from an earlier run
+    if (listen_fd < 0 || bind(listen_fd, (sockaddr*) &addr, sizeof(addr)) < 0 || listen(listen_fd, 64) < 0) {
+        cerr << "Error: cannot listen on " << socket_path << ": " << strerror(errno) << "\n";
+        return 1;
+    }
+
+    WorkerPool pool(graph, nworkers);
+    atomic<bool> shutting_down(false);
+
+    cout << "Serving MST queries on " << socket_path << "\n";
+    cout << "Vertices: " << graph.size() << "\n";
+    cout << "Workers: " << nworkers << endl;
+
+    // One detached thread per client; the pool does the actual work
+    set<int> client_fds;
+    mutex clients_m;
+    condition_variable clients_done;
+    while (!shutting_down) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        lock_guard<mutex> lock(clients_m);
+        client_fds.insert(fd);
+        thread([&, fd] {
+            serve_connection(fd, pool, shutting_down, listen_fd);
+            lock_guard<mutex> lock(clients_m);
+            client_fds.erase(fd);
+            close(fd);
+            clients_done.notify_all();
+        }).detach();
+    }
+
+    // Unblock idle clients, wait for them to finish, then stop the workers
+    {
+        unique_lock<mutex> lock(clients_m);
+        for (int fd : client_fds) shutdown(fd, SHUT_RDWR);
+        clients_done.wait(lock, [&] { return client_fds.empty(); });
+    }
+    pool.stop();
+
+    close(listen_fd);
+    unlink(socket_path.c_str());
+    cout << pool.stats().substr(3) << "\n";
+    return 0;
+}
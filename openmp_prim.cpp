@@ -3,20 +3,32 @@
 #include <vector>      // for dynamic vector
 #include <limits>      // for INF constant
 #include <omp.h>       // for OpenMP parallelism
+#include "prim_perf.h" // optional hardware counter profiling
+#include "graph_codec.h" // compressed block graph format
+#include "mst_cache.h"  // content-addressed MST result cache
+#include "mst_cluster.h" // single-linkage clustering of the MST
+#include "prim_options.h" // shared command-line options
 
 #define INF 9999       // Represent infinity for Prim's algorithm
 
 using namespace std;
 
-int main() {
-    string input_file = "input.csv";             // Input file
+int main(int argc, char** argv) {
     string output_file = "openmp_output.csv";    // Output file
 
-    ifstream fin(input_file);    // Open the input CSV file
+    // Command-line options, see prim_options.h
+    PrimOptions opts;
+    string error;
+    if (!parse_prim_options(argc, argv, opts, error)) {
+        cerr << "Error: " << error << "\n";
+        return 1;
+    }
+
+    ifstream fin(opts.input_file);    // Open the input CSV file
     ofstream fout(output_file); // Open the output CSV file
 
     if (!fin.is_open()) {
-        cerr << "Error: cannot open input file " << input_file << "\n";
+        cerr << "Error: cannot open input file " << opts.input_file << "\n";
         return 1;
     }
 
@@ -24,18 +36,26 @@ int main() {
     vector<vector<int>> graph;
     string line;
 
-    // Read the adjacency matrix from CSV
-    while (getline(fin, line)) {
-        vector<int> row;
-        size_t pos = 0;
-
-        while ((pos = line.find(',')) != string::npos) {
-            row.push_back(stoi(line.substr(0, pos)));
-            line.erase(0, pos + 1);
+    if (is_compressed_graph(opts.input_file)) {
+        // Compressed block file: blocks are decoded in parallel by the team
+        if (!read_compressed_graph(opts.input_file, graph)) {
+            cerr << "Error: " << opts.input_file << " is not a valid compressed graph\n";
+            return 1;
         }
+    } else {
+        // Read the adjacency matrix from CSV
+        while (getline(fin, line)) {
+            vector<int> row;
+            size_t pos = 0;
+
+            while ((pos = line.find(',')) != string::npos) {
+                row.push_back(stoi(line.substr(0, pos)));
+                line.erase(0, pos + 1);
+            }
 
-        row.push_back(stoi(line)); // Add the last number in the row
-        graph.push_back(row);
+            row.push_back(stoi(line)); // Add the last number in the row
+            graph.push_back(row);
+        }
     }
 
     int V = graph.size(); // Number of vertices
@@ -46,19 +66,113 @@ int main() {
 
     key[0] = 0; // Start from the vertex 0
 
+    // Live vertex set for --compact: live[0..nlive) are not in MST, pos[v] is v's slot
+    vector<int> live(V), pos(V);
+    for (int v = 0; v < V; v++) {
+        live[v] = v;
+        pos[v] = v;
+    }
+    int nlive = V;
+
+    // Each thread opens its own counters so they follow that thread
+    PerfProfile prof;
+    if (opts.profile) {
+        prof.init(omp_get_max_threads());
+        #pragma omp parallel
+        prof.open_thread(omp_get_thread_num());
+    }
+
+    // Result cache: the same graph and parameters give the same parent[]
+    // (both merges below break ties by lowest vertex id, so the tree does not
+    // depend on thread timing)
+    MstCache cache(opts.cache_dir);
+    uint64_t cache_key = 0;
+    long long total_weight = 0;
+    bool cached = false;
+    if (opts.use_cache) {
+        MstCacheResult r = report_cache_lookup(cache, graph, "openmp;root=0;inf=" + to_string(INF), parent, total_weight);
+        cache_key = r.key;
+        cached = r.hit;
+    }
+
     double start = omp_get_wtime(); 
 
     // Repeat for V vertices
-    for (int count = 0; count < V; count++) {
+    int iterations = 0;
+    for (int count = 0; count < V && !cached; count++) {
         int min_key = INF;
         int u = -1;
 
+        if (opts.compact) {
+            // Minimum key over the live slots only, ties broken by vertex id
+            #pragma omp parallel
+            {
+                int tid = omp_get_thread_num();
+                int local_min = INF;
+                int local_u = -1;
+
+                prof.begin(tid);
+                #pragma omp for nowait
+                for (int i = 0; i < nlive; i++) {
+                    int v = live[i];
+                    if (key[v] < local_min || (key[v] == local_min && v < local_u)) {
+                        local_min = key[v];
+                        local_u = v;
+                    }
+                }
+                prof.end(tid, PHASE_SELECT);
+
+                prof.begin(tid);
+                #pragma omp critical
+                {
+                    if (local_min < min_key || (local_min == min_key && local_u != -1 && local_u < u)) {
+                        min_key = local_min;
+                        u = local_u;
+                    }
+                }
+                prof.end(tid, PHASE_REDUCE);
+                prof.barrier(tid);
+            }
+
+            if (u == -1) break;
+
+            inMST[u] = true;
+            iterations++;
+
+            // Swap the last live vertex into u's slot
+            int last = live[--nlive];
+            live[pos[u]] = last;
+            pos[last] = pos[u];
+
+            const vector<int>& row = graph[u];
+
+            #pragma omp parallel
+            {
+                int tid = omp_get_thread_num();
+
+                prof.begin(tid);
+                #pragma omp for nowait
+                for (int i = 0; i < nlive; i++) {
+                    int v = live[i];
+                    if (row[v] && row[v] < key[v]) {
+                        key[v] = row[v];
+                        parent[v] = u;
+                    }
+                }
+                prof.end(tid, PHASE_RELAX);
+                prof.barrier(tid);
+            }
+            continue;
+        }
+
         // Find the minimum key vertex not yet included in MST
         #pragma omp parallel
         {
+            int tid = omp_get_thread_num();
             int local_min = INF;
             int local_u = -1;
 
+            prof.begin(tid);
             #pragma omp for nowait
             for (int v = 0; v < V; v++) {
                 if (!inMST[v] && key[v] < local_min) {
@@ -68,34 +182,57 @@ int main() {
                          local_u = v;
                 }
             }
+            prof.end(tid, PHASE_SELECT);
 
+            // Ties go to the lowest vertex id, whatever order the threads arrive in
+            prof.begin(tid);
             #pragma omp critical
             {
-                if (local_min < min_key) {
+                if (local_min < min_key || (local_min == min_key && local_u != -1 && local_u < u)) {
                       min_key = local_min;
                     u = local_u;
                 }
             }
+            prof.end(tid, PHASE_REDUCE);
+            prof.barrier(tid);
         }
 
         if (u == -1) break;
 
         inMST[u] = true; 
+        iterations++;
 
-        #pragma omp parallel for
-        for (int v = 0; v < V; v++) {
-            if (graph[u][v] && !inMST[v] && graph[u][v] < key[v]) {
-                key[v] = graph[u][v];
-                parent[v] = u;
+        #pragma omp parallel
+        {
+            int tid = omp_get_thread_num();
+
+            prof.begin(tid);
+            #pragma omp for nowait
+            for (int v = 0; v < V; v++) {
+                if (graph[u][v] && !inMST[v] && graph[u][v] < key[v]) {
+                    key[v] = graph[u][v];
+                    parent[v] = u;
+                }
             }
+            prof.end(tid, PHASE_RELAX);
+            prof.barrier(tid);
         }
     }
 
+    if (opts.use_cache && !cached) {
+        total_weight = mst_total_weight(graph, parent);
+        if (!cache.store(cache_key, parent, total_weight))
+            cerr << "Warning: could not write cache entry to " << opts.cache_dir << "\n";
+    }
+
+    if (opts.profile) cout << prof.report("openmp", iterations);
+
 
   vector<vector<int>> mst(V, vector<int>(V, INF));
 
     for (int i = 1; i < V; i++) {
         int u = parent[i], v = i;
+        if (u < 0) continue; // Not reachable from vertex 0
         mst[u][v] = graph[u][v];
         mst[v][u] = graph[v][u];  
     }
@@ -113,14 +250,19 @@ int main() {
     double duration = end - start;
 
 
-    ofstream log("log_time.txt", ios::app);
-    log << "OpenMP," << V << "," << omp_get_max_threads() << "," << duration << "\n";
-    log.close();
+    if (should_log_time(opts, cached)) {
+        ofstream log("log_time.txt", ios::app);
+        log << "OpenMP," << V << "," << omp_get_max_threads() << "," << duration << "\n";
+        log.close();
+    }
 
 
     cout << "Execution time: " << duration << " seconds\n";
     cout << "Number of threads used: " << omp_get_max_threads() << "\n";
     cout << "Output is ready in file: " << output_file << "\n";
 
+    // Single-linkage clustering on the finished tree
+    if (!opts.cluster_queries.empty()) run_cluster_queries("openmp", parent, mst_edge_weights(graph, parent), opts.cluster_queries, opts.cluster_binary);
+
     return 0;
 }
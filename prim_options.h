@@ -0,0 +1,58 @@
+// Command-line options shared by the four Prim binaries, and which of
+// their runs go into log_time.txt.
+#pragma once
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "mst_cache.h"    // MST_CACHE_DIR
+#include "mst_cluster.h"  // ClusterQuery, parse_cluster_queries
+
+// --compact: keep the vertices not yet in the MST in a packed live list,
+//            so selection and relax only touch live vertices
+// --profile: hardware counters per select / reduce / relax phase, per thread and rank
+// --input FILE: CSV or compressed (.pmb) graph instead of input.csv
+// --cache, --cache-dir DIR: reuse the stored MST of an unchanged graph
+// --clusters K,..., --cut W,...: single-linkage clusters from the MST
+// --cluster-format csv|bin: label file format (default csv)
+// --block NB: block size of the hybrid's block-cyclic 2-D decomposition (default 64)
+struct PrimOptions {
+    bool compact = false;
+    bool profile = false;
+    std::string input_file = "input.csv";
+    bool use_cache = false;
+    std::string cache_dir = MST_CACHE_DIR;
+    std::vector<ClusterQuery> cluster_queries;
+    bool cluster_binary = false;
+    int block = 64;
+};
+
+// Fills opts from argv; on a malformed value returns false and says why in error
+inline bool parse_prim_options(int argc, char** argv, PrimOptions& opts, std::string& error) {
+    bool clusters_ok = true;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--compact") opts.compact = true;
+        if (arg == "--profile") opts.profile = true;
+        if (arg == "--input" && i + 1 < argc) opts.input_file = argv[++i];
+        if (arg == "--cache") opts.use_cache = true;
+        if (arg == "--cache-dir" && i + 1 < argc) {
+            opts.use_cache = true;
+            opts.cache_dir = argv[++i];
+        }
+        if (arg == "--clusters" && i + 1 < argc) clusters_ok &= parse_cluster_queries(argv[++i], false, opts.cluster_queries);
+        if (arg == "--cut" && i + 1 < argc) clusters_ok &= parse_cluster_queries(argv[++i], true, opts.cluster_queries);
+        if (arg == "--cluster-format" && i + 1 < argc) opts.cluster_binary = std::string(argv[++i]) == "bin";
+        if (arg == "--block" && i + 1 < argc) opts.block = std::atoi(argv[++i]);
+    }
+
+    if (!clusters_ok) error = "--clusters expects k values >= 1, --cut expects integer weights";
+    else if (opts.block < 1) error = "--block expects a size >= 1";
+    return error.empty();
+}
+
+// Only plain timed runs are logged: a cache hit did no Prim work, and
+// --profile adds barriers and counter reads to every iteration
+inline bool should_log_time(const PrimOptions& opts, bool cached) {
+    return !cached && !opts.profile;
+}
@@ -0,0 +1,207 @@
+// Opt-in hardware counter profiling of the Prim hot loops (--profile).
+//
+// Each thread opens its own perf_event_open counter group (cycles,
+// instructions, LLC read misses, branch misses, backend stalled cycles) and
+// attributes the deltas to the select / reduce / relax phase it is in.
+// Barrier wait is measured as wall time spent in an explicit barrier.
+// When profiling is off every hook is a single predictable branch.
+#pragma once
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Phases of one Prim iteration that get their own counters
+enum PerfPhase { PHASE_SELECT, PHASE_REDUCE, PHASE_RELAX, NUM_PHASES };
+
+// Events opened per thread; any the CPU does not support are skipped
+enum PerfCounter { CNT_CYCLES, CNT_INSTRUCTIONS, CNT_LLC_MISSES, CNT_BRANCH_MISSES, CNT_STALLED, NUM_COUNTERS };
+
+static const char* const PERF_PHASE_NAMES[NUM_PHASES] = {"select", "reduce", "relax"};
+
+#define PERF_CACHE_LINE 64  // bytes moved per LLC miss
+
+// Per-thread counter state, padded so threads never share a cache line
+struct alignas(64) PerfThread {
+    int fds[NUM_COUNTERS];              // fds[CNT_CYCLES] is the group leader
+    int slot[NUM_COUNTERS];             // position in the group read, -1 if not opened
+    int nopen = 0;
+    int open_errno = 0;
+    uint64_t last[NUM_COUNTERS] = {};
+    double last_time = 0;
+    uint64_t total[NUM_PHASES][NUM_COUNTERS] = {};
+    double seconds[NUM_PHASES] = {};
+    double barrier_wait = 0;
+
+    PerfThread() {
+        for (int c = 0; c < NUM_COUNTERS; c++) {
+            fds[c] = -1;
+            slot[c] = -1;
+        }
+    }
+};
+
+class PerfProfile {
+public:
+    bool enabled = false;
+
+    // Allocates per-thread slots; counters are opened later by each thread
+    void init(int nthreads) {
+        enabled = true;
+        threads.assign(nthreads, PerfThread());
+    }
+
+    // Opens the counters of the calling thread. Must run on the thread that
+    // will be measured, since perf events follow the opening thread.
+    void open_thread(int tid) {
+        if (!enabled) return;
+        PerfThread& t = threads[tid];
+
+        static const uint32_t types[NUM_COUNTERS] = {
+            PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+            PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE};
+        static const uint64_t configs[NUM_COUNTERS] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+            PERF_COUNT_HW_BRANCH_MISSES,
+            PERF_COUNT_HW_STALLED_CYCLES_BACKEND};
+
+        for (int c = 0; c < NUM_COUNTERS; c++) {
+            int leader = t.fds[CNT_CYCLES];
+            if (c != CNT_CYCLES && leader == -1) break;  // no group without a leader
+
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = types[c];
+            attr.config = configs[c];
+            attr.disabled = (c == CNT_CYCLES);
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+
+            int fd = (int) syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+            if (fd == -1) {
+                if (c == CNT_CYCLES) t.open_errno = errno;
+                continue;
+            }
+            t.fds[c] = fd;
+            t.slot[c] = t.nopen++;
+        }
+
+        if (t.fds[CNT_CYCLES] != -1) {
+            ioctl(t.fds[CNT_CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(t.fds[CNT_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    // Starts a measured section on thread tid
+    void begin(int tid) {
+        if (!enabled) return;
+        PerfThread& t = threads[tid];
+        sample(t, t.last, t.last_time);
+    }
+
+    // Ends the section started by begin() and charges it to phase
+    void end(int tid, PerfPhase phase) {
+        if (!enabled) return;
+        PerfThread& t = threads[tid];
+        uint64_t now_cnt[NUM_COUNTERS];
+        double now_time;
+        sample(t, now_cnt, now_time);
+        for (int c = 0; c < NUM_COUNTERS; c++) t.total[phase][c] += now_cnt[c] - t.last[c];
+        t.seconds[phase] += now_time - t.last_time;
+    }
+
+    // Timed explicit barrier; every thread of the parallel region must call it
+    void barrier(int tid) {
+        if (!enabled) return;
+        double t0 = wall_time();
+#ifdef _OPENMP
+        #pragma omp barrier
+#endif
+        threads[tid].barrier_wait += wall_time() - t0;
+    }
+
+    // Adds externally measured wait time (e.g. an MPI_Barrier) to thread tid
+    void add_wait(int tid, double seconds) {
+        if (enabled) threads[tid].barrier_wait += seconds;
+    }
+
+    // Per-thread summary: time, counters, IPC and LLC bytes per iteration for each phase
+    std::string report(const std::string& label, long iterations) const {
+        std::ostringstream out;
+        if (iterations < 1) iterations = 1;
+        for (size_t tid = 0; tid < threads.size(); tid++) {
+            const PerfThread& t = threads[tid];
+            out << "[profile] " << label << " thread " << tid
+                << ": barrier_wait=" << std::fixed << std::setprecision(6) << t.barrier_wait << "s";
+            if (t.fds[CNT_CYCLES] == -1)
+                out << " (hardware counters unavailable: " << strerror(t.open_errno) << ")";
+            out << "\n";
+
+            for (int p = 0; p < NUM_PHASES; p++) {
+                const uint64_t* n = t.total[p];
+                out << "  " << std::left << std::setw(7) << PERF_PHASE_NAMES[p] << std::right
+                    << std::fixed << std::setprecision(6) << t.seconds[p] << "s";
+                if (t.fds[CNT_CYCLES] != -1) {
+                    out << " cycles=" << n[CNT_CYCLES]
+                        << " instr=" << n[CNT_INSTRUCTIONS]
+                        << " IPC=" << std::setprecision(2)
+                        << (n[CNT_CYCLES] ? (double) n[CNT_INSTRUCTIONS] / n[CNT_CYCLES] : 0.0);
+                    counter(out, t, n, CNT_LLC_MISSES, "llc_miss");
+                    if (t.slot[CNT_LLC_MISSES] != -1)
+                        out << " bytes/iter=" << std::setprecision(1)
+                            << (double) n[CNT_LLC_MISSES] * PERF_CACHE_LINE / iterations;
+                    counter(out, t, n, CNT_BRANCH_MISSES, "br_miss");
+                    counter(out, t, n, CNT_STALLED, "stalled");
+                }
+                out << "\n";
+            }
+        }
+        return out.str();
+    }
+
+    ~PerfProfile() {
+        for (PerfThread& t : threads)
+            for (int c = 0; c < NUM_COUNTERS; c++)
+                if (t.fds[c] != -1) close(t.fds[c]);
+    }
+
+    static double wall_time() {
+        using namespace std::chrono;
+        return duration<double>(steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    std::vector<PerfThread> threads;
+
+    // Reads the whole counter group in one syscall; missing counters read as 0
+    static void sample(const PerfThread& t, uint64_t* values, double& time) {
+        for (int c = 0; c < NUM_COUNTERS; c++) values[c] = 0;
+        if (t.fds[CNT_CYCLES] != -1) {
+            uint64_t buf[1 + NUM_COUNTERS];
+            if (read(t.fds[CNT_CYCLES], buf, sizeof(buf)) > 0) {
+                for (int c = 0; c < NUM_COUNTERS; c++)
+                    if (t.slot[c] != -1 && (uint64_t) t.slot[c] < buf[0]) values[c] = buf[1 + t.slot[c]];
+            }
+        }
+        time = wall_time();
+    }
+
+    static void counter(std::ostringstream& out, const PerfThread& t, const uint64_t* n,
+                        PerfCounter c, const char* name) {
+        if (t.slot[c] == -1) out << " " << name << "=n/a";
+        else out << " " << name << "=" << n[c];
+    }
+};
@@ -3,25 +3,37 @@
 #include <vector>    // For dynamic 2D vector (adjacency matrix)
 #include <limits>    // For defining INF (infinite) values
 #include <chrono>    // For measuring execution time
+#include "prim_perf.h" // Optional hardware counter profiling
+#include "graph_codec.h" // Compressed block graph format
+#include "mst_cache.h" // Content-addressed MST result cache
+#include "mst_cluster.h" // Single-linkage clustering of the MST
+#include "prim_options.h" // Shared command-line options
 
 using namespace std;
 using namespace std::chrono; // to use high_resolution_clock and duration
 
 #define INF 9999  // Define a large value to represent infinity (no edge)
 
-int main()
+int main(int argc, char** argv)
 {
-    // Input and output file names (fixed)
-    string input_file = "input.csv";           
+    // Output file name (the input is opts.input_file, input.csv unless --input is given)
     string output_file = "serial_output.csv";  
 
-    ifstream fin(input_file);      // Open input file stream
+    // Command-line options, see prim_options.h
+    PrimOptions opts;
+    string error;
+    if (!parse_prim_options(argc, argv, opts, error)) {
+        cerr << "Error: " << error << "\n";
+        return 1;
+    }
+
+    ifstream fin(opts.input_file);      // Open input file stream
     ofstream fout(output_file);    // Open output file stream
 
     // Check if input file is open successfully
     if (!fin.is_open())
     {
-        cerr << "Error: Could not open " << input_file << endl;
+        cerr << "Error: Could not open " << opts.input_file << endl;
         return 1;  // Exit with error
     }
     
@@ -29,23 +41,35 @@ int main()
     vector<vector<int>> graph;
     string line;
 
-    // Read CSV file line by line and convert each line to a vector<int>
-    while (getline(fin, line))
+    if (is_compressed_graph(opts.input_file))
     {
-        vector<int> row;
-        size_t pos = 0;
-
-        while ((pos = line.find(',')) != string::npos )
+        // Compressed block file: decode straight into the adjacency matrix
+        if (!read_compressed_graph(opts.input_file, graph))
         {
-            row.push_back(stoi(line.substr(0, pos)));
-            line.erase(0, pos + 1);                    
+            cerr << "Error: " << opts.input_file << " is not a valid compressed graph" << endl;
+            return 1;
         }
+    }
+    else
+    {
+        // Read CSV file line by line and convert each line to a vector<int>
+        while (getline(fin, line))
+        {
+            vector<int> row;
+            size_t pos = 0;
 
-       
-        row.push_back(stoi(line)); 
+            while ((pos = line.find(',')) != string::npos )
+            {
+                row.push_back(stoi(line.substr(0, pos)));
+                line.erase(0, pos + 1);                    
+            }
 
-   
-        graph.push_back(row);
+           
+            row.push_back(stoi(line)); 
+
+       
+            graph.push_back(row);
+        }
     }
     fin.close();  
 
@@ -58,14 +82,82 @@ int main()
 
     key[0] = 0; 
 
+    // live[0..nlive) holds the vertices not yet in the MST, pos[v] is the slot of v in live
+    vector<int> live(V), pos(V);
+    for (int v = 0; v < V; v++) {
+        live[v] = v;
+        pos[v] = v;
+    }
+    int nlive = V;
+
+    PerfProfile prof;
+    if (opts.profile) {
+        prof.init(1);
+        prof.open_thread(0);
+    }
+
+    // Result cache: the same graph and parameters give the same parent[]
+    // (looked up before the timer starts, so a miss is timed like a normal run)
+    MstCache cache(opts.cache_dir);
+    uint64_t cache_key = 0;
+    long long total_weight = 0;
+    bool cached = false;
+    if (opts.use_cache) {
+        MstCacheResult r = report_cache_lookup(cache, graph, "serial;root=0;inf=" + to_string(INF), parent, total_weight);
+        cache_key = r.key;
+        cached = r.hit;
+    }
+
     // Start measuring time before MST computation
     auto start = high_resolution_clock::now();
 
     // Prim's algorithm main loop: run V-1 times to add edges to MST
-    for (int count = 0; count < V - 1; count++)
+    for (int count = 0; count < V - 1 && !cached; count++)
     {
         int min = INF, u = -1;
 
+        if (opts.compact)
+        {
+            prof.begin(0);
+
+            // Find the minimum key among live vertices only
+            // (ties go to the lowest vertex id, same as the full scan)
+            for (int i = 0; i < nlive; i++) {
+                int v = live[i];
+                if (key[v] < min || (key[v] == min && v < u))
+                {
+                    min = key[v];
+                    u = v;
+                }
+            }
+
+            prof.end(0, PHASE_SELECT);
+
+            inMST[u] = true;
+
+            // Remove u from the live set: move the last live vertex into its slot
+            int last = live[--nlive];
+            live[pos[u]] = last;
+            pos[last] = pos[u];
+
+            // Relax only the live vertices, gathering graph[u][live[i]]
+            prof.begin(0);
+            const vector<int>& row = graph[u];
+            for (int i = 0; i < nlive; i++)
+            {
+                int v = live[i];
+                if (row[v] && row[v] < key[v])
+                {
+                    parent[v] = u;
+                    key[v] = row[v];
+                }
+            }
+            prof.end(0, PHASE_RELAX);
+            continue;
+        }
+
+        prof.begin(0);
+
         // Find vertex u not in MST with minimum key value
         for (int v = 0; v < V; v++) {
             if (!inMST[v] && key[v] < min)
@@ -75,9 +167,11 @@ int main()
             }
         }
 
+        prof.end(0, PHASE_SELECT);
+
         inMST[u] = true; 
 
-        
+        prof.begin(0);
         for (int v = 0; v < V; v++)
         {
             // If there is an edge u->v, v not in MST, and weight less than current key[v]
@@ -87,8 +181,17 @@ int main()
                 key[v] = graph[u][v]; // Update minimum weight to include v
             }
         }
+        prof.end(0, PHASE_RELAX);
+    }
+
+    if (opts.use_cache && !cached) {
+        total_weight = mst_total_weight(graph, parent);
+        if (!cache.store(cache_key, parent, total_weight))
+            cerr << "Warning: could not write cache entry to " << opts.cache_dir << "\n";
     }
 
+    if (opts.profile) cout << prof.report("serial", V - 1);
+
     // Create adjacency matrix for MST initialized with zeros
 vector<vector<int>> mst(V, vector<int>(V, INF));
 
@@ -116,12 +219,17 @@ vector<vector<int>> mst(V, vector<int>(V, INF));
 
 
  
-    ofstream log("log_time.txt", ios::app);
-    log << "Serial," << V << ",1," << duration << "\n";
-    log.close();
+    if (should_log_time(opts, cached)) {
+        ofstream log("log_time.txt", ios::app);
+        log << "Serial," << V << ",1," << duration << "\n";
+        log.close();
+    }
 
 cout << "Execution time: " << duration << " seconds\n";
 cout << "Output is ready in file: " << output_file << "\n";
 
+    // Single-linkage clustering on the finished tree
+    if (!opts.cluster_queries.empty()) run_cluster_queries("serial", parent, mst_edge_weights(graph, parent), opts.cluster_queries, opts.cluster_binary);
+
     return 0;
 }